@@ -1 +1,2 @@
-make && sudo rmmod virtual_fan; sudo insmod virtual_fan.ko
\ No newline at end of file
+# pico-fan 挂接着串口时模块处于占用状态，rmmod 前先停服务
+make && sudo systemctl stop pico-fan; sudo rmmod virtual_fan; sudo insmod virtual_fan.ko; sudo systemctl start pico-fan
\ No newline at end of file
@@ -0,0 +1,103 @@
+package main
+
+import (
+	"fmt"
+	"log"
+	"os"
+	"strconv"
+	"strings"
+	"syscall"
+	"time"
+	"unsafe"
+)
+
+// 内核模块导出的线路规程编号，0 或不存在表示内核不支持直连
+const ldiscParamPath = "/sys/module/virtual_fan/parameters/pico_ldisc"
+
+// 波特率位掩码，Go 的 syscall 包没有导出 CBAUD，取自 <asm-generic/termbits.h>
+const termiosCBAUD = 0010017
+
+// 读取内核模块的线路规程编号
+func readLdiscNum() int {
+	data, err := os.ReadFile(ldiscParamPath)
+	if err != nil {
+		return 0
+	}
+	val, err := strconv.Atoi(strings.TrimSpace(string(data)))
+	if err != nil {
+		return 0
+	}
+	return val
+}
+
+// 将 Pico 串口挂接到内核线路规程，之后 PWM 与 RPM 都由内核直接收发。
+// 线路规程只在串口打开期间有效，所以这里持有串口直到设备断开。
+// attached 为 false 表示没能挂接上，调用方稍后重试挂接。
+func runLdiscAttach(portName string, ldisc int) (attached bool, err error) {
+	f, err := os.OpenFile(portName, os.O_RDWR|syscall.O_NOCTTY, 0)
+	if err != nil {
+		return false, fmt.Errorf("打开串口失败: %v", err)
+	}
+	defer f.Close()
+	fd := f.Fd()
+
+	// 配置为 115200 8N1 原始模式，与 tarm/serial 的设置一致
+	var t syscall.Termios
+	if err := ioctl(fd, syscall.TCGETS, unsafe.Pointer(&t)); err != nil {
+		return false, fmt.Errorf("读取串口参数失败: %v", err)
+	}
+	t.Iflag &^= syscall.IGNBRK | syscall.BRKINT | syscall.PARMRK | syscall.ISTRIP |
+		syscall.INLCR | syscall.IGNCR | syscall.ICRNL | syscall.IXON
+	t.Oflag &^= syscall.OPOST
+	t.Lflag &^= syscall.ECHO | syscall.ECHONL | syscall.ICANON | syscall.ISIG | syscall.IEXTEN
+	t.Cflag &^= syscall.CSIZE | syscall.PARENB | termiosCBAUD
+	t.Cflag |= syscall.CS8 | syscall.CREAD | syscall.CLOCAL | syscall.B115200
+	if err := ioctl(fd, syscall.TCSETS, unsafe.Pointer(&t)); err != nil {
+		return false, fmt.Errorf("设置串口参数失败: %v", err)
+	}
+
+	disc := int32(ldisc)
+	if err := ioctl(fd, syscall.TIOCSETD, unsafe.Pointer(&disc)); err != nil {
+		return false, fmt.Errorf("挂接线路规程失败: %v", err)
+	}
+	fmt.Printf("已挂接内核直连: %s (ldisc %d)\n", portName, ldisc)
+
+	// 设备拔出后串口被 hangup，ioctl 返回错误，此时退出触发重连
+	for {
+		time.Sleep(3 * time.Second)
+		if err := ioctl(fd, syscall.TIOCGETD, unsafe.Pointer(&disc)); err != nil {
+			return true, fmt.Errorf("串口已断开: %v", err)
+		}
+		if int(disc) != ldisc {
+			return true, fmt.Errorf("线路规程已被切换为 %d", disc)
+		}
+	}
+}
+
+func ioctl(fd uintptr, req uintptr, arg unsafe.Pointer) error {
+	_, _, errno := syscall.Syscall(syscall.SYS_IOCTL, fd, req, uintptr(arg))
+	if errno != 0 {
+		return errno
+	}
+	return nil
+}
+
+// 内核直连模式：挂接并阻塞到设备断开。挂接失败 (设备未就绪、驱动未 probe、
+// 短暂 EBUSY 等) 只等待后重试，不回退到轮询桥接
+func runLdiscSession(ldisc int) {
+	portName := FindPicoPort()
+	if portName == "" {
+		log.Printf("等待硬件就绪: 未发现 Pico 设备")
+		time.Sleep(3 * time.Second)
+		return
+	}
+
+	attached, err := runLdiscAttach(portName, ldisc)
+	if err != nil {
+		log.Printf("内核直连: %v", err)
+	}
+	if attached {
+		fmt.Println("硬件连接断开，尝试重新恢复...")
+	}
+	time.Sleep(2 * time.Second)
+}
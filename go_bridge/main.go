@@ -21,6 +21,13 @@ func main() {
 	fmt.Println("=== Pico 虚拟风扇已启动 ===")
 
 	for {
+		// 0. 内核支持直连时只负责挂接串口，PWM/RPM 由内核直接收发；
+		//    只有模块没有 pico_ldisc 参数或为 0 时才走下面的轮询桥接
+		if ldisc := readLdiscNum(); ldisc > 0 {
+			runLdiscSession(ldisc)
+			continue
+		}
+
 		// 1. 尝试初始化：查找串口和 HWMON 路径
 		s, hwmonPath, err := initializeHardware()
 		if err != nil {
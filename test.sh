@@ -6,11 +6,11 @@ make
 # install to kernel
 insmod virtual_fan.ko
 
-#unmound
-sudo rmmod virtual_fan;
+#unmound (pico-fan 挂接着串口时模块处于占用状态，先停服务)
+sudo systemctl stop pico-fan; sudo rmmod virtual_fan;
 
 #test
-make && sudo rmmod virtual_fan; sudo insmod virtual_fan.ko
+make && sudo systemctl stop pico-fan; sudo rmmod virtual_fan; sudo insmod virtual_fan.ko; sudo systemctl start pico-fan
 
 #show kernel log
 dmesg -wH
@@ -7,16 +7,108 @@
 #include <linux/fs.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
+#include <linux/tty.h>
+#include <linux/tty_ldisc.h>
+#include <linux/version.h>
+#include <linux/workqueue.h>
 
 // 1. 必须定义宏
 #define NUM_FANS 3
 
+// Pico 串口直连：由内核线路规程 (line discipline) 直接收发 Pico 协议，
+// 不再经过 Go 桥接的轮询。Pico 对应的通道与 Go 桥接一致 (pwm1 / fan1_input)
+#define PICO_CHANNEL 0
+#define PICO_LINE_MAX 128
+
+// 5.14 起 tty_ldisc_ops 自带 num 字段，低版本内核不编译该功能，仍使用 Go 桥接
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0)
+#define VIRTUAL_FAN_PICO_LDISC
+#endif
+
+#ifndef N_DEVELOPMENT
+#define N_DEVELOPMENT 29
+#endif
+
 // 2. 结构体成员必须定义为数组
 struct virtual_fan_data {
     long pwm_value[NUM_FANS];   // 数组：保存每个风扇的 PWM
     long enabled[NUM_FANS];     // 数组：保存每个风扇的使能状态
     long fan_speed[NUM_FANS];   // 数组：保存来自 Go 的真实 RPM
+
+    struct mutex pico_lock;          // 保护 pico_tty、pico_pending 与 pwm_value[PICO_CHANNEL]
+    struct tty_struct *pico_tty;     // 已挂接线路规程的 Pico 串口，未挂接时为 NULL
+    bool pico_pending;               // 还有占空比没发给 Pico
+    struct work_struct pico_tx_work; // write_wakeup 可能在中断上下文，重发放到工作队列
+    char pico_line[PICO_LINE_MAX];   // 接收行缓冲，仅在 receive_buf 中使用
+    size_t pico_line_len;
+    bool pico_line_bad;              // 当前行溢出或有错误标志，整行丢弃
 };
+
+// 当前注册的设备数据，供线路规程找到 hwmon 数据
+static struct virtual_fan_data *virtual_fan_active;
+
+// 线路规程编号，0 表示关闭直连功能；挂接程序从 /sys/module/virtual_fan/parameters 读取
+static int pico_ldisc = N_DEVELOPMENT;
+module_param(pico_ldisc, int, 0444);
+MODULE_PARM_DESC(pico_ldisc, "tty line discipline number for the Pico link (0 = disabled)");
+
+// 把待发的占空比发给 Pico，格式与 Go 桥接一致：{"set_duty": 0-100}
+// 调用方必须持有 pico_lock
+static void virtual_fan_pico_flush_locked(struct virtual_fan_data *data) {
+    struct tty_struct *tty = data->pico_tty;
+    char cmd[32];
+    int len, ret;
+
+    if (!tty || !data->pico_pending) return;
+
+    len = scnprintf(cmd, sizeof(cmd), "{\"set_duty\": %ld}\n",
+                    data->pwm_value[PICO_CHANNEL] * 100 / 255);
+
+    // 缓冲区放不下整行时先不发，避免半行指令；等 write_wakeup 再发最新值
+    set_bit(TTY_DO_WRITE_WAKEUP, &tty->flags);
+    if (tty_write_room(tty) < (unsigned int)len) return;
+    clear_bit(TTY_DO_WRITE_WAKEUP, &tty->flags);
+
+    ret = tty->ops->write(tty, (const u8 *)cmd, len);
+    if (ret != len)
+        pr_warn_ratelimited("Virtual Fan: Pico write short (%d/%d)\n", ret, len);
+    data->pico_pending = false;
+}
+
+// 保存 Pico 通道的 PWM 并推送，存储与发送在同一把锁内，保证 Pico 收到的是最后写入的值
+static void virtual_fan_pico_set_pwm(struct virtual_fan_data *data, long pwm) {
+    mutex_lock(&data->pico_lock);
+    data->pwm_value[PICO_CHANNEL] = pwm;
+    data->pico_pending = true;
+    virtual_fan_pico_flush_locked(data);
+    mutex_unlock(&data->pico_lock);
+}
+
+// 串口有空间后重发待发的占空比
+static void virtual_fan_pico_tx_work(struct work_struct *work) {
+    struct virtual_fan_data *data = container_of(work, struct virtual_fan_data, pico_tx_work);
+
+    mutex_lock(&data->pico_lock);
+    virtual_fan_pico_flush_locked(data);
+    mutex_unlock(&data->pico_lock);
+}
+
+// 解析 Pico 上报的一行：{"rpm": 1200, "duty": 60}
+static void virtual_fan_pico_parse_line(struct virtual_fan_data *data) {
+    const char *p;
+    long rpm;
+
+    data->pico_line[data->pico_line_len] = '\0';
+    p = skip_spaces(data->pico_line);
+    // 非 JSON 行是 Pico 的调试输出，忽略
+    if (*p != '{') return;
+
+    p = strstr(p, "\"rpm\"");
+    if (p && sscanf(p, "\"rpm\" : %ld", &rpm) == 1 && rpm >= 0)
+        data->fan_speed[PICO_CHANNEL] = rpm;
+}
 // 属性文件的显示函数
 static ssize_t virtual_fan_marker_show(struct device *dev, struct device_attribute *attr, char *buf) {
     return snprintf(buf, PAGE_SIZE, "vFanByTk\n");
@@ -93,7 +185,11 @@ static int virtual_fan_write(struct device *dev, enum hwmon_sensor_types type,
             case hwmon_pwm_input:
                 if (!data->enabled[channel]) return -EACCES;
                 if (val < 0 || val > 255) return -EINVAL;
-                data->pwm_value[channel] = val;
+                // 每次写入都推送，Pico 重启后重写同一值即可重新同步
+                if (channel == PICO_CHANNEL)
+                    virtual_fan_pico_set_pwm(data, val);
+                else
+                    data->pwm_value[channel] = val;
                 return 0;
         }
     }
@@ -124,6 +220,130 @@ static const struct hwmon_chip_info virtual_fan_chip_info = {
     .info = virtual_fan_info,
 };
 
+#ifdef VIRTUAL_FAN_PICO_LDISC
+// 线路规程挂接：用户态对 Pico 串口执行 TIOCSETD 时触发
+static int virtual_fan_ldisc_open(struct tty_struct *tty) {
+    struct virtual_fan_data *data = virtual_fan_active;
+
+    if (!capable(CAP_SYS_ADMIN)) return -EPERM;
+    if (!data) return -ENODEV;
+    if (!tty->ops->write) return -EOPNOTSUPP;
+
+    mutex_lock(&data->pico_lock);
+    if (data->pico_tty) {
+        mutex_unlock(&data->pico_lock);
+        return -EBUSY;
+    }
+    tty->disc_data = data;
+    tty->receive_room = 65536;
+
+    data->pico_tty = tty;
+    data->pico_line_len = 0;
+    data->pico_line_bad = false;
+    // 挂接后立即同步当前 PWM
+    data->pico_pending = true;
+    virtual_fan_pico_flush_locked(data);
+    mutex_unlock(&data->pico_lock);
+
+    pr_info("Virtual Fan: Pico attached on %s\n", tty->name);
+    return 0;
+}
+
+// 串口关闭、拔出 (hangup) 或切回 N_TTY 时触发
+static void virtual_fan_ldisc_close(struct tty_struct *tty) {
+    struct virtual_fan_data *data = tty->disc_data;
+
+    if (!data) return;
+
+    mutex_lock(&data->pico_lock);
+    if (data->pico_tty == tty) data->pico_tty = NULL;
+    mutex_unlock(&data->pico_lock);
+
+    // pico_tty 已清空，工作项即使还在运行也不会再碰这个 tty
+    cancel_work_sync(&data->pico_tx_work);
+    clear_bit(TTY_DO_WRITE_WAKEUP, &tty->flags);
+    tty->disc_data = NULL;
+    pr_info("Virtual Fan: Pico detached from %s\n", tty->name);
+}
+
+// 接收 Pico 数据，按行拆分后直接写入 fan_speed[]
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 6, 0)
+static void virtual_fan_ldisc_receive(struct tty_struct *tty, const u8 *cp,
+                                      const u8 *fp, size_t count) {
+#else
+static void virtual_fan_ldisc_receive(struct tty_struct *tty, const unsigned char *cp,
+                                      const char *fp, int count) {
+#endif
+    struct virtual_fan_data *data = tty->disc_data;
+    size_t i;
+
+    if (!data) return;
+
+    for (i = 0; i < (size_t)count; i++) {
+        if (fp && fp[i] != TTY_NORMAL) {
+            data->pico_line_bad = true;
+            continue;
+        }
+        if (cp[i] == '\n') {
+            if (!data->pico_line_bad) virtual_fan_pico_parse_line(data);
+            data->pico_line_len = 0;
+            data->pico_line_bad = false;
+        } else if (data->pico_line_len < PICO_LINE_MAX - 1) {
+            data->pico_line[data->pico_line_len++] = cp[i];
+        } else {
+            data->pico_line_bad = true;
+        }
+    }
+}
+
+// 驱动发送缓冲有空间了，可能在中断上下文调用，不能直接拿 mutex
+static void virtual_fan_ldisc_write_wakeup(struct tty_struct *tty) {
+    struct virtual_fan_data *data = tty->disc_data;
+
+    if (data) schedule_work(&data->pico_tx_work);
+}
+
+static struct tty_ldisc_ops virtual_fan_ldisc_ops = {
+    .owner = THIS_MODULE,
+    .name = "virtual_fan_pico",
+    .open = virtual_fan_ldisc_open,
+    .close = virtual_fan_ldisc_close,
+    .receive_buf = virtual_fan_ldisc_receive,
+    .write_wakeup = virtual_fan_ldisc_write_wakeup,
+};
+
+static bool virtual_fan_ldisc_registered;
+
+static void virtual_fan_ldisc_register(void) {
+    int ret;
+
+    if (pico_ldisc <= 0) return;
+
+    virtual_fan_ldisc_ops.num = pico_ldisc;
+    ret = tty_register_ldisc(&virtual_fan_ldisc_ops);
+    if (ret) {
+        // 直连是可选功能，失败时仍可使用 Go 桥接
+        pr_warn("Virtual Fan: Failed to register line discipline %d (%d)\n", pico_ldisc, ret);
+        pico_ldisc = 0;
+        return;
+    }
+    virtual_fan_ldisc_registered = true;
+    pr_info("Virtual Fan: Pico line discipline registered as %d\n", pico_ldisc);
+}
+
+static void virtual_fan_ldisc_unregister(void) {
+    if (virtual_fan_ldisc_registered) tty_unregister_ldisc(&virtual_fan_ldisc_ops);
+    virtual_fan_ldisc_registered = false;
+}
+#else
+static void virtual_fan_ldisc_register(void) {
+    pico_ldisc = 0;
+}
+
+static void virtual_fan_ldisc_unregister(void) {
+}
+#endif
+
 // 基础 Probe 函数
 static int virtual_fan_probe(struct platform_device *pdev) {
     struct device *hwmon_dev;
@@ -140,12 +360,15 @@ static int virtual_fan_probe(struct platform_device *pdev) {
         data->enabled[i] = 1;
         data->fan_speed[i] = 0;
     }
+    mutex_init(&data->pico_lock);
+    INIT_WORK(&data->pico_tx_work, virtual_fan_pico_tx_work);
 
     hwmon_dev = devm_hwmon_device_register_with_info(&pdev->dev, "virtual_pwm_fan",
                                                      data, &virtual_fan_chip_info, NULL);
     if (IS_ERR(hwmon_dev)) return PTR_ERR(hwmon_dev);
 
     platform_set_drvdata(pdev, data);
+    virtual_fan_active = data;
 
     // 创建 sysfs 属性文件
     ret = device_create_file(&pdev->dev, &dev_attr_marker);
@@ -181,11 +404,15 @@ static int __init virtual_fan_init(void) {
         return PTR_ERR(v_pdev);
     }
 
+    virtual_fan_ldisc_register();
+
     pr_info("Virtual Fan: Device registered successfully!\n");
     return 0;
 }
 
 static void __exit virtual_fan_exit(void) {
+    virtual_fan_ldisc_unregister();
+    virtual_fan_active = NULL;
     platform_device_unregister(v_pdev);
     platform_driver_unregister(&virtual_fan_driver);
 }